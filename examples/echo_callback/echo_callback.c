@@ -76,7 +76,7 @@ int main(void)
 
     init_uart_cfg(&cfg);
     init_UART(&cfg);
-    cb.rx_buff.rx_callback = rx_cb;
+    cb.rx_callback = rx_cb;
 
     wakeup = 0;
 
@@ -0,0 +1,143 @@
+/*
+ * uartavr interrupt driven serial communication for 8bit avrs
+ * Copyright © 2016 Christian Rapp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the organization nor the
+ * names of its contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ''AS IS'' AND ANY  EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL yourname BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*H**********************************************************************
+* FILENAME :        mspim_example.c
+*
+* DESCRIPTION :
+*       Master SPI Mode example for uartavr
+*
+* NOTES :
+*       The library is compiled with MSPIM (see Makefile). This example reads
+*       the JEDEC ID of a SPI flash (e.g. W25Q32) once a second.
+*
+*       Wiring for the ATmega328P:
+*       TXD (PD1) -> MOSI, RXD (PD0) <- MISO, XCK (PD4) -> SCK, PB2 -> CS
+*       An LED on PB5 is switched on if a flash answered.
+*
+*       The chip select is released from the transfer complete callback.
+*
+* AUTHOR :    Christian Rapp
+*/
+
+#include <avr/io.h>
+#include <avr/sleep.h>
+
+#include <string.h>
+
+#include "uart.h"
+
+#define JEDEC_ID 0x9F
+
+volatile uint8_t xfer_done; /* signal main loop the transfer is complete */
+volatile uint8_t overflow_cnt; /* an additional counter for Timer0 */
+volatile uint8_t tick;         /* time for the next read */
+
+void xfer_cb(void)
+{
+    /* deselect the flash as soon as the last byte is in */
+    PORTB |= _BV(PB2);
+    xfer_done = 1;
+}
+
+int main(void)
+{
+    struct UARTcfg cfg;
+    memset(&cfg, 0, sizeof(struct UARTcfg));
+
+    init_uart_cfg(&cfg);
+    /* SPI mode 0, 1MHz SCK */
+    cfg.spi_mode = 0;
+    cfg.spi_ubrr = 7;
+    cfg.xfer_complete = xfer_cb;
+    init_UART(&cfg);
+
+    /* chip select and led as output, CS is low active */
+    DDRB |= _BV(PB2) | _BV(PB5);
+    PORTB |= _BV(PB2);
+
+    xfer_done = 0;
+    tick = 1;
+    overflow_cnt = 0;
+    TCNT0 = 0;
+    /* set prescaler for Timer0 to 1024 and activate overflow interrupt */
+    TCCR0B |= _BV(CS02) | _BV(CS00);
+    TIMSK0 |= _BV(TOIE0);
+
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    sleep_enable();
+
+    sei();
+
+    while (1) {
+        while (!tick && !xfer_done) {
+            sleep_mode();
+        }
+        if (tick && !spi_busy_UART()) {
+            tick = 0;
+            /*
+             * the byte received with the command is garbage, only keep the
+             * answer clocked in with the three dummy bytes
+             */
+            const char cmd = JEDEC_ID;
+            const char dummy[3] = {0, 0, 0};
+            PORTB &= ~_BV(PB2);
+            /* keep CS low until the last dummy byte was exchanged */
+            spi_begin_UART();
+            spi_write_UART(&cmd, 1);
+            spi_transfer_UART(&dummy[0], sizeof(dummy));
+            spi_commit_UART();
+        }
+        if (xfer_done) {
+            xfer_done = 0;
+            char id[3];
+            uint8_t err = 0;
+            for (uint8_t i = 0; i < sizeof(id); i++)
+                err |= get_UART(&id[i]);
+            /* id[0] is the manufacturer */
+            if (!err && id[0] != 0x00 && id[0] != (char)0xFF)
+                PORTB |= _BV(PB5);
+            else
+                PORTB &= ~_BV(PB5);
+        }
+    }
+
+    return 0;
+}
+
+ISR(TIMER0_OVF_vect)
+{
+    /* roughly every second with 16MHz */
+    if (++overflow_cnt == 61) {
+        overflow_cnt = 0;
+        tick = 1;
+    }
+}
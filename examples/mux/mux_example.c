@@ -0,0 +1,132 @@
+/*
+ * uartavr interrupt driven serial communication for 8bit avrs
+ * Copyright © 2016 Christian Rapp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the organization nor the
+ * names of its contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ''AS IS'' AND ANY  EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL yourname BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*H**********************************************************************
+* FILENAME :        mux_example.c
+*
+* DESCRIPTION :
+*       Logical channel multiplexing example for uartavr
+*
+* NOTES :
+*       The library is compiled with MUX_CHANNELS=3 (see Makefile). Channel 0
+*       carries log messages, channel 1 is a command channel that echoes back
+*       whatever it receives and channel 2 carries binary telemetry.
+*
+*       On the wire every channel switch is announced by MUX_ESC followed by
+*       the channel number. A data byte equal to MUX_ESC is doubled. The host
+*       has to undo this framing to split the streams again.
+*
+*       This example was written for the ATmega328P
+*
+* AUTHOR :    Christian Rapp
+*/
+
+#include <avr/io.h>
+
+#include <string.h>
+
+#include "uart.h"
+
+#define CH_LOG 0
+#define CH_CMD 1
+#define CH_TELEMETRY 2
+
+volatile uint8_t cmd_ready;    /* command channel received a line */
+volatile uint8_t overflow_cnt; /* an additional counter for Timer0 */
+volatile uint8_t tick;         /* signal main loop to send telemetry */
+
+/**
+ * Called from USART_RX_vect whenever the command channel received a byte. The
+ * command channel is line based so we wake up the main loop on carriage return
+ * or if the channel queue is full.
+ */
+void cmd_cb(void)
+{
+    struct MuxBuff *rx = &mux.chan[CH_CMD].rx_buff;
+    uint8_t last = rx->inpos ? rx->inpos - 1 : MUX_BUFFSIZE - 1;
+    if (rx->items == MUX_BUFFSIZE || rx->buff[last] == '\r') {
+        cmd_ready = 1;
+    }
+}
+
+int main(void)
+{
+    struct UARTcfg cfg;
+    memset(&cfg, 0, sizeof(struct UARTcfg));
+
+    init_uart_cfg(&cfg);
+    init_UART(&cfg);
+    mux.chan[CH_CMD].rx_callback = cmd_cb;
+    /* telemetry frames are 4 bytes, let them go out in one piece */
+    mux_set_weight(CH_TELEMETRY, 4);
+
+    cmd_ready = 0;
+    tick = 0;
+    overflow_cnt = 0;
+    TCNT0 = 0;
+    /* set prescaler for Timer0 to 1024 and activate overflow interrupt */
+    TCCR0B |= _BV(CS02) | _BV(CS00);
+    TIMSK0 |= _BV(TOIE0);
+
+    sei();
+
+    /* puts_UART writes to channel 0 */
+    puts_UART("mux example started");
+
+    uint16_t counter = 0;
+    while (1) {
+        if (cmd_ready) {
+            char s[MUX_BUFFSIZE + 1];
+            cmd_ready = 0;
+            gets_mux_UART(CH_CMD, &s[0]);
+            puts_mux_UART(CH_CMD, &s[0]);
+            puts_UART("command echoed");
+        }
+        if (tick) {
+            tick = 0;
+            counter++;
+            char frame[4] = {0x55, (char)(counter >> 8), (char)counter, 0};
+            frame[3] = frame[0] ^ frame[1] ^ frame[2];
+            write_mux_UART(CH_TELEMETRY, &frame[0], sizeof(frame));
+        }
+    }
+
+    return 0;
+}
+
+ISR(TIMER0_OVF_vect)
+{
+    /* roughly every second with 16MHz */
+    if (++overflow_cnt == 61) {
+        overflow_cnt = 0;
+        tick = 1;
+    }
+}
@@ -0,0 +1,189 @@
+/*
+ * uartavr interrupt driven serial communication for 8bit avrs
+ * Copyright © 2016 Christian Rapp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the organization nor the
+ * names of its contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ''AS IS'' AND ANY  EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL yourname BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "lzss.h"
+
+#define LZSS_MASK (LZSS_WINDOW - 1)
+
+static void lzss_put_bits(struct LZSSEncoder *enc, uint16_t bits, uint8_t n)
+{
+    while (n--) {
+        enc->bitbuf = (enc->bitbuf << 1) | ((bits >> n) & 1);
+        if (++enc->bitcnt == 8) {
+            enc->out((char)enc->bitbuf);
+            enc->bitbuf = 0;
+            enc->bitcnt = 0;
+        }
+    }
+}
+
+/*
+ * Emit one token for the pending bytes starting at head - pend. Matches may
+ * run into the pending bytes themselves, the decoder copies byte by byte so
+ * this is fine.
+ */
+static void lzss_encode_token(struct LZSSEncoder *enc)
+{
+    uint16_t cur = (enc->head - enc->pend) & LZSS_MASK;
+    uint16_t max_dist = enc->filled - enc->pend;
+    uint8_t best_len = 0;
+    uint16_t best_dist = 0;
+
+    for (uint16_t dist = 1; dist <= max_dist; dist++) {
+        uint16_t src = (cur - dist) & LZSS_MASK;
+        uint8_t len = 0;
+        while (len < enc->pend &&
+               enc->hist[(src + len) & LZSS_MASK] ==
+                   enc->hist[(cur + len) & LZSS_MASK])
+            len++;
+        if (len > best_len) {
+            best_len = len;
+            best_dist = dist;
+            if (len == enc->pend)
+                break;
+        }
+    }
+
+    if (best_len >= LZSS_MIN_MATCH) {
+        lzss_put_bits(enc, 0, 1);
+        lzss_put_bits(enc, best_len - LZSS_MIN_MATCH + 1, LZSS_LENGTH_BITS);
+        lzss_put_bits(enc, best_dist - 1, LZSS_WINDOW_BITS);
+        enc->pend -= best_len;
+    } else {
+        lzss_put_bits(enc, 1, 1);
+        lzss_put_bits(enc, (uint8_t)enc->hist[cur], 8);
+        enc->pend--;
+    }
+}
+
+void lzss_enc_init(struct LZSSEncoder *enc, void (*out)(char c))
+{
+    enc->head = 0;
+    enc->filled = 0;
+    enc->pend = 0;
+    enc->bitbuf = 0;
+    enc->bitcnt = 0;
+    enc->out = out;
+}
+
+void lzss_enc_put(struct LZSSEncoder *enc, char c)
+{
+    enc->hist[enc->head] = c;
+    enc->head = (enc->head + 1) & LZSS_MASK;
+    if (enc->filled < LZSS_WINDOW)
+        enc->filled++;
+    if (++enc->pend == LZSS_MAX_MATCH)
+        lzss_encode_token(enc);
+}
+
+void lzss_enc_flush(struct LZSSEncoder *enc)
+{
+    while (enc->pend)
+        lzss_encode_token(enc);
+    /* already aligned, the decoder has seen every token completely */
+    if (enc->bitcnt == 0)
+        return;
+    lzss_put_bits(enc, 0, 1 + LZSS_LENGTH_BITS);
+    if (enc->bitcnt)
+        lzss_put_bits(enc, 0, 8 - enc->bitcnt);
+}
+
+#ifdef LZSS_DECODER
+enum LZSS_STATE {
+    LZSS_FLAG,    /* waiting for the token flag */
+    LZSS_LITERAL, /* reading a literal byte */
+    LZSS_LENGTH,  /* reading the length code of a back reference */
+    LZSS_OFFSET   /* reading the offset of a back reference */
+};
+
+void lzss_dec_init(struct LZSSDecoder *dec, void (*out)(char c))
+{
+    dec->head = 0;
+    dec->acc = 0;
+    dec->need = 1;
+    dec->state = LZSS_FLAG;
+    dec->len = 0;
+    dec->out = out;
+}
+
+static void lzss_dec_emit(struct LZSSDecoder *dec, char c)
+{
+    dec->hist[dec->head] = c;
+    dec->head = (dec->head + 1) & LZSS_MASK;
+    dec->out(c);
+}
+
+void lzss_dec_put(struct LZSSDecoder *dec, char c)
+{
+    for (int8_t bit = 7; bit >= 0; bit--) {
+        dec->acc = (dec->acc << 1) | (((uint8_t)c >> bit) & 1);
+        if (--dec->need)
+            continue;
+
+        switch (dec->state) {
+        case LZSS_FLAG:
+            dec->state = dec->acc ? LZSS_LITERAL : LZSS_LENGTH;
+            dec->need = dec->acc ? 8 : LZSS_LENGTH_BITS;
+            break;
+        case LZSS_LITERAL:
+            lzss_dec_emit(dec, (char)dec->acc);
+            dec->state = LZSS_FLAG;
+            dec->need = 1;
+            break;
+        case LZSS_LENGTH:
+            if (dec->acc == 0) {
+                /* sync marker, drop the padding in this byte */
+                dec->acc = 0;
+                dec->state = LZSS_FLAG;
+                dec->need = 1;
+                return;
+            }
+            dec->len = dec->acc + LZSS_MIN_MATCH - 1;
+            dec->state = LZSS_OFFSET;
+            dec->need = LZSS_WINDOW_BITS;
+            break;
+        case LZSS_OFFSET: {
+            uint16_t src = (dec->head - dec->acc - 1) & LZSS_MASK;
+            while (dec->len--) {
+                lzss_dec_emit(dec, dec->hist[src]);
+                src = (src + 1) & LZSS_MASK;
+            }
+            dec->state = LZSS_FLAG;
+            dec->need = 1;
+            break;
+        }
+        default:
+            break;
+        }
+        dec->acc = 0;
+    }
+}
+#endif /* LZSS_DECODER */
@@ -0,0 +1,179 @@
+/*
+ * uartavr interrupt driven serial communication for 8bit avrs
+ * Copyright © 2016 Christian Rapp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the organization nor the
+ * names of its contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ''AS IS'' AND ANY  EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL yourname BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LZSS_H
+#define LZSS_H
+
+#include <inttypes.h>
+#include <stddef.h>
+
+/**
+ * @file lzss.h
+ *
+ * @author Christian Rapp
+ * @date 2016
+ * @copyright BSD-3-Clause
+ *
+ * @details
+ *
+ * A small streaming LZSS codec. It is used by uartavr to compress the TX stream
+ * when TX_COMPRESS is defined and by the host tools in the `tools` subfolder to
+ * decompress it again. The code does not depend on any AVR header.
+ *
+ * The stream is a sequence of tokens, every token starts with a flag bit.
+ * Bits are written MSB first.
+ *
+ * * `1` + 8 bit: a literal byte
+ * * `0` + LZSS_LENGTH_BITS length code (1..) + LZSS_WINDOW_BITS offset: copy
+ *   `code + LZSS_MIN_MATCH - 1` bytes starting `offset + 1` bytes back
+ * * `0` + LZSS_LENGTH_BITS zero bits: sync marker, the remaining bits of the
+ *   current byte are padding
+ *
+ * The sync marker is written by lzss_enc_flush() so the receiver can decode
+ * everything that was sent so far without waiting for more data.
+ */
+
+/**
+ * @brief Size of the history window is 2^LZSS_WINDOW_BITS bytes
+ */
+#ifndef LZSS_WINDOW_BITS
+#define LZSS_WINDOW_BITS 8
+#endif /* ifndef LZSS_WINDOW_BITS */
+
+/**
+ * @brief Number of bits used to encode the match length
+ */
+#ifndef LZSS_LENGTH_BITS
+#define LZSS_LENGTH_BITS 4
+#endif /* ifndef LZSS_LENGTH_BITS */
+
+/**
+ * @brief Size of the history window in bytes
+ */
+#define LZSS_WINDOW (1U << LZSS_WINDOW_BITS)
+
+/**
+ * @brief Shortest match that is encoded as a back reference
+ */
+#define LZSS_MIN_MATCH 2
+
+/**
+ * @brief Longest match that can be encoded as a back reference
+ */
+#define LZSS_MAX_MATCH ((1U << LZSS_LENGTH_BITS) + LZSS_MIN_MATCH - 2)
+
+#if LZSS_WINDOW_BITS > 12 || LZSS_LENGTH_BITS > 7
+#error "LZSS_WINDOW_BITS must be <= 12 and LZSS_LENGTH_BITS <= 7"
+#endif
+
+/**
+ * @brief Compile the decoder
+ *
+ * @details
+ * The firmware only encodes, so on AVR the decoder is left out unless you
+ * define LZSS_DECODER yourself. Everywhere else it is always available.
+ */
+#if !defined(__AVR__) && !defined(LZSS_DECODER)
+#define LZSS_DECODER
+#endif
+
+/**
+ * @brief State of a streaming LZSS encoder
+ */
+struct LZSSEncoder {
+    char hist[LZSS_WINDOW]; /**< Already encoded and pending bytes */
+    uint16_t head;          /**< Write position in hist */
+    uint16_t filled;        /**< Number of valid bytes in hist */
+    uint8_t pend;           /**< Bytes in hist that are not encoded yet */
+    uint8_t bitbuf;         /**< Bits waiting to be written */
+    uint8_t bitcnt;         /**< Number of bits in bitbuf */
+    void (*out)(char c);    /**< Called for every compressed byte */
+};
+
+/**
+ * @brief Initialize an encoder
+ *
+ * @param enc Pointer to the encoder
+ * @param out Function that receives the compressed bytes
+ */
+void lzss_enc_init(struct LZSSEncoder *enc, void (*out)(char c));
+
+/**
+ * @brief Feed one byte to the encoder
+ *
+ * @param enc Pointer to the encoder
+ * @param c The byte to compress
+ *
+ * @details
+ * Bytes are buffered until LZSS_MAX_MATCH bytes are pending, so output lags
+ * behind input. Use lzss_enc_flush() to force everything out.
+ */
+void lzss_enc_put(struct LZSSEncoder *enc, char c);
+
+/**
+ * @brief Encode all pending bytes and align the stream to a byte boundary
+ *
+ * @param enc Pointer to the encoder
+ */
+void lzss_enc_flush(struct LZSSEncoder *enc);
+
+#ifdef LZSS_DECODER
+/**
+ * @brief State of a streaming LZSS decoder
+ */
+struct LZSSDecoder {
+    char hist[LZSS_WINDOW]; /**< Decoded bytes */
+    uint16_t head;          /**< Write position in hist */
+    uint16_t acc;           /**< Bits of the field that is being read */
+    uint8_t need;           /**< Number of bits still missing in acc */
+    uint8_t state;          /**< Which field is being read */
+    uint8_t len;            /**< Length of the current back reference */
+    void (*out)(char c);    /**< Called for every decoded byte */
+};
+
+/**
+ * @brief Initialize a decoder
+ *
+ * @param dec Pointer to the decoder
+ * @param out Function that receives the decoded bytes
+ */
+void lzss_dec_init(struct LZSSDecoder *dec, void (*out)(char c));
+
+/**
+ * @brief Feed one compressed byte to the decoder
+ *
+ * @param dec Pointer to the decoder
+ * @param c The compressed byte
+ */
+void lzss_dec_put(struct LZSSDecoder *dec, char c);
+#endif /* LZSS_DECODER */
+
+#endif /* ifndef LZSS_H */
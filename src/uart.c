@@ -31,22 +31,163 @@
 
 #include "uart.h"
 
+#ifdef LOW_POWER
+#include <avr/sleep.h>
+#endif /* LOW_POWER */
+
+struct CBuffer cb;
+
+#if defined(BAUD_RUNTIME) || defined(LOW_POWER)
+/* the TX complete interrupt is used to find out when the line is idle */
+#define TX_IDLE_TRACKING
+#endif
+
+#ifdef TX_IDLE_TRACKING
+static volatile uint8_t tx_idle; /* nothing in UDR0 or the shift register */
+#endif /* TX_IDLE_TRACKING */
+
+#ifdef LOW_POWER
+static volatile uint8_t lp_wakeup; /* data arrived or notify_UART() was called */
+static struct PowerStats lp_stats;
+#ifdef LOW_POWER_CLOCK
+static uint16_t lp_stamp; /* LOW_POWER_CLOCK when the last interval started */
+#endif /* LOW_POWER_CLOCK */
+#endif /* LOW_POWER */
+
+#ifndef MSPIM
+/*
+ * Data was put in the TX buffer, make sure the UDRE ISR picks it up.
+ */
+static void tx_start(void)
+{
+#ifdef LOW_POWER
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-variable"
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#pragma GCC diagnostic pop
+    {
+        /* the TX complete ISR may have switched off the transmitter */
+        UCSR0B |= _BV(TXEN0) | _BV(UDRIE0);
+    }
+#else
+    UCSR0B |= _BV(UDRIE0); /* activate buffer empty interrupt */
+#endif /* LOW_POWER */
+}
+#endif /* MSPIM */
+
+#ifdef TX_COMPRESS
+static struct LZSSEncoder tx_enc; /* compresses everything before the TX buffer */
+
+static void tx_push(char c)
+{
+    /* losing a byte would corrupt the compressed stream so wait for the ISR */
+    while (cb_push(c, TX_BUFF) != 0)
+        tx_start();
+    tx_start();
+}
+#endif /* TX_COMPRESS */
+
+#ifdef MSPIM
+static volatile uint8_t spi_inflight; /* bytes in UDR0 or the shift register */
+static void (*spi_xfer_complete)(void);
+static volatile uint16_t spi_keep;    /* bytes to store before spi_discard */
+static volatile uint16_t spi_discard; /* received bytes to throw away */
+static volatile uint16_t spi_lost;    /* received bytes that did not fit */
+static uint8_t spi_tail_discard; /* the last queued bytes are from spi_write */
+static volatile uint8_t spi_open;     /* spi_begin_UART() without commit */
+#endif /* MSPIM */
+
+#ifdef MPCM
+static uint8_t mpcm_address;
+static uint8_t mpcm_filter;
+static void (*mpcm_addr_callback)(void);
+#endif /* MPCM */
+
+/*
+ * The ring operations shared by the RX/TX buffers and the mux channel queues.
+ * buff holds size bytes, the indices and the item count belong to the ring.
+ */
+static uint8_t ring_pop(char *c, const char *buff, buff_index_t size,
+                        buff_index_t *outpos, buff_index_t *items)
+{
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-variable"
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#pragma GCC diagnostic pop
+    {
+        if (*items == 0) {
+            return 1;
+        }
+    }
+
+    *c = buff[(*outpos)++];
+
+    if (*outpos == size)
+        *outpos = 0;
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-variable"
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#pragma GCC diagnostic pop
+    {
+        (*items)--;
+    }
+
+    return 0;
+}
+
+static uint8_t ring_push(char c, char *buff, buff_index_t size,
+                         buff_index_t *inpos, buff_index_t *items)
+{
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-variable"
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#pragma GCC diagnostic pop
+    {
+        if (*items == size) {
+            return 1;
+        }
+    }
+
+    buff[(*inpos)++] = c;
+
+    if (*inpos == size)
+        *inpos = 0;
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-variable"
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#pragma GCC diagnostic pop
+    {
+        (*items)++;
+    }
+
+    return 0;
+}
+
 void cb_init(void)
 {
+#ifndef MUX_CHANNELS
     struct DirBuff *dbuffs[] = {&(cb.rx_buff), &(cb.tx_buff)};
     for (uint8_t i = 0; i < 2; i++) {
-        dbuffs[i]->start_ptr = &dbuffs[i]->buff[0];
-        dbuffs[i]->end_ptr = &dbuffs[i]->buff[BUFFSIZE];
-        dbuffs[i]->inpos_ptr = &dbuffs[i]->buff[0];
-        dbuffs[i]->outpos_ptr = &dbuffs[i]->buff[0];
+        dbuffs[i]->inpos = 0;
+        dbuffs[i]->outpos = 0;
         dbuffs[i]->items = 0;
-        dbuffs[i]->full = 0;
-        dbuffs[i]->rx_callback = NULL;
-        dbuffs[i]->tx_callback = NULL;
-        dbuffs[i]->buff_empty = NULL;
     }
+#endif /* MUX_CHANNELS */
+#ifndef NO_RX_CALLBACK
+    cb.rx_callback = NULL;
+#endif /* NO_RX_CALLBACK */
+#ifndef NO_TX_CALLBACK
+    cb.tx_callback = NULL;
+#endif /* NO_TX_CALLBACK */
+#ifndef NO_EMPTY_CALLBACK
+    cb.buff_empty = NULL;
+#endif /* NO_EMPTY_CALLBACK */
 }
 
+#ifndef MUX_CHANNELS
+
 void get_direction_buffer(enum DIR_BUFFS dir, struct DirBuff **dbuff)
 {
     switch (dir) {
@@ -69,96 +210,302 @@ uint8_t cb_pop(char *c, enum DIR_BUFFS dir)
     if (!dbuff)
         return 2;
 
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wunused-variable"
-    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
-#pragma GCC diagnostic pop
-    {
-        if (dbuff->inpos_ptr == dbuff->outpos_ptr && dbuff->full != 1) {
-            return 1;
-        }
-    }
+    return ring_pop(c, dbuff->buff, BUFFSIZE, &dbuff->outpos, &dbuff->items);
+}
 
-    *c = *(dbuff->outpos_ptr++);
+uint8_t cb_push(char c, enum DIR_BUFFS dir)
+{
+    struct DirBuff *dbuff = NULL;
 
-    if (dbuff->outpos_ptr == dbuff->end_ptr)
-        dbuff->outpos_ptr = dbuff->start_ptr;
+    get_direction_buffer(dir, &dbuff);
 
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wunused-variable"
-    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
-#pragma GCC diagnostic pop
-    {
-        dbuff->items--;
+    if (!dbuff)
+        return 2;
+
+    return ring_push(c, dbuff->buff, BUFFSIZE, &dbuff->inpos, &dbuff->items);
+}
+
+#endif /* MUX_CHANNELS */
 
-        if (dbuff->full)
-            dbuff->full = 0;
+#ifdef MUX_CHANNELS
+
+struct Mux mux;
+
+void mux_init(void)
+{
+    for (uint8_t i = 0; i < MUX_CHANNELS; i++) {
+        struct MuxChannel *chan = &mux.chan[i];
+        chan->rx_buff.inpos = chan->rx_buff.outpos = chan->rx_buff.items = 0;
+        chan->tx_buff.inpos = chan->tx_buff.outpos = chan->tx_buff.items = 0;
+        chan->weight = MUX_WEIGHT;
+#ifndef NO_RX_CALLBACK
+        chan->rx_callback = NULL;
+#endif /* NO_RX_CALLBACK */
     }
+    /* no channel announced yet, the first byte on the wire is a header */
+    mux.tx_chan = MUX_ESC;
+    mux.tx_credit = 0;
+    mux.tx_esc = 0;
+    mux.rx_chan = 0;
+    mux.rx_esc = 0;
+}
 
-    return 0;
+void get_mux_buffer(uint8_t ch, enum DIR_BUFFS dir, struct MuxBuff **mbuff)
+{
+    if (ch >= MUX_CHANNELS) {
+        *mbuff = NULL;
+        return;
+    }
+    switch (dir) {
+    case RX_BUFF:
+        *mbuff = &(mux.chan[ch].rx_buff);
+        break;
+    case TX_BUFF:
+        *mbuff = &(mux.chan[ch].tx_buff);
+    default:
+        break;
+    }
 }
 
-uint8_t cb_push(char c, enum DIR_BUFFS dir)
+uint8_t mux_pop(char *c, uint8_t ch, enum DIR_BUFFS dir)
 {
-    struct DirBuff *dbuff = NULL;
+    struct MuxBuff *mbuff = NULL;
 
-    get_direction_buffer(dir, &dbuff);
+    get_mux_buffer(ch, dir, &mbuff);
 
-    if (!dbuff)
+    if (!mbuff)
         return 2;
 
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wunused-variable"
-    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
-#pragma GCC diagnostic pop
-    {
-        if (dbuff->inpos_ptr == dbuff->outpos_ptr && dbuff->full == 1) {
+    return ring_pop(c, mbuff->buff, MUX_BUFFSIZE, &mbuff->outpos,
+                    &mbuff->items);
+}
+
+uint8_t mux_push(char c, uint8_t ch, enum DIR_BUFFS dir)
+{
+    struct MuxBuff *mbuff = NULL;
+
+    get_mux_buffer(ch, dir, &mbuff);
+
+    if (!mbuff)
+        return 2;
+
+    return ring_push(c, mbuff->buff, MUX_BUFFSIZE, &mbuff->inpos,
+                     &mbuff->items);
+}
+
+void mux_set_weight(uint8_t ch, uint8_t weight)
+{
+    if (ch < MUX_CHANNELS)
+        mux.chan[ch].weight = weight ? weight : 1;
+}
+
+/*
+ * Fetch the next byte that has to go on the wire. Called from the UDRE ISR.
+ * A channel keeps the line until its credit is used up or its queue is empty,
+ * afterwards the next channel with pending data is selected. A switch costs
+ * two bytes (MUX_ESC + channel number), so we stay on the current channel as
+ * long as nobody else is waiting.
+ */
+static uint8_t mux_next_tx(char *c)
+{
+    if (mux.tx_esc) {
+        mux.tx_esc = 0;
+        *c = mux.tx_esc_byte;
+        return 0;
+    }
+
+    uint8_t cur = mux.tx_chan < MUX_CHANNELS ? mux.tx_chan : MUX_CHANNELS - 1;
+    if (mux.tx_chan >= MUX_CHANNELS || mux.tx_credit == 0 ||
+        mux.chan[cur].tx_buff.items == 0) {
+        uint8_t next = cur;
+        uint8_t found = 0;
+        for (uint8_t i = 0; i < MUX_CHANNELS; i++) {
+            if (++next == MUX_CHANNELS)
+                next = 0;
+            if (mux.chan[next].tx_buff.items) {
+                found = 1;
+                break;
+            }
+        }
+        if (!found)
             return 1;
+        mux.tx_credit = mux.chan[next].weight;
+        if (next != mux.tx_chan) {
+            mux.tx_chan = next;
+            mux.tx_esc = 1;
+            mux.tx_esc_byte = (char)next;
+            *c = MUX_ESC;
+            return 0;
         }
     }
 
-    *(dbuff->inpos_ptr++) = c;
+    mux_pop(c, mux.tx_chan, TX_BUFF);
+    mux.tx_credit--;
+    if (*c == (char)MUX_ESC) {
+        mux.tx_esc = 1;
+        mux.tx_esc_byte = MUX_ESC;
+    }
+    return 0;
+}
 
-    if (dbuff->inpos_ptr == dbuff->end_ptr)
-        dbuff->inpos_ptr = dbuff->start_ptr;
+/*
+ * Route one received byte to the channel announced by the last header.
+ * Called from the RX ISR.
+ */
+static void mux_rx_byte(char c)
+{
+    if (mux.rx_esc) {
+        mux.rx_esc = 0;
+        if (c != (char)MUX_ESC) {
+            /* channel header, unknown channels are dropped */
+            mux.rx_chan = (uint8_t)c;
+            return;
+        }
+    } else if (c == (char)MUX_ESC) {
+        mux.rx_esc = 1;
+        return;
+    }
 
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wunused-variable"
-    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
-#pragma GCC diagnostic pop
-    {
-        dbuff->items++;
+#ifdef NO_RX_CALLBACK
+    mux_push(c, mux.rx_chan, RX_BUFF);
+#else
+    if (mux_push(c, mux.rx_chan, RX_BUFF) != 2 &&
+        mux.chan[mux.rx_chan].rx_callback)
+        mux.chan[mux.rx_chan].rx_callback();
+#endif /* NO_RX_CALLBACK */
+}
 
-        if (dbuff->inpos_ptr == dbuff->outpos_ptr)
-            dbuff->full = 1;
+uint8_t put_mux_UART(uint8_t ch, const char c)
+{
+    if (mux_push(c, ch, TX_BUFF) == 0) {
+        tx_start();
+        return 0;
     }
+    return 1;
+}
 
-    return 0;
+void puts_mux_UART(uint8_t ch, const char *s)
+{
+    while (*s) {
+        put_mux_UART(ch, *s);
+        s++;
+    }
+    char *cr_ptr = CR;
+    while (*cr_ptr) {
+        put_mux_UART(ch, *cr_ptr);
+        cr_ptr++;
+    }
 }
 
+size_t write_mux_UART(uint8_t ch, const char *data, size_t len)
+{
+    size_t written = 0;
+    while (written < len && put_mux_UART(ch, data[written]) == 0)
+        written++;
+    return written;
+}
+
+uint8_t get_mux_UART(uint8_t ch, char *s)
+{
+    if (mux_pop(s, ch, RX_BUFF) == 0)
+        return 0;
+    return 1;
+}
+
+uint8_t gets_mux_UART(uint8_t ch, char *s)
+{
+    char *s_ptr = s;
+    uint8_t ret = 1;
+    while (mux_pop(s_ptr, ch, RX_BUFF) == 0) {
+        s_ptr++;
+        ret = 0;
+    }
+    *s_ptr = '\0';
+    return ret;
+}
+
+#endif /* MUX_CHANNELS */
+
 void init_uart_cfg(struct UARTcfg *cfg)
 {
     /* init config with default values */
     if (cfg) {
         cfg->tx = _BV(TXEN0);
         cfg->rx = _BV(RXEN0);
+#ifndef NO_TX_CALLBACK
         cfg->tx_callback = NULL;
+#endif /* NO_TX_CALLBACK */
+#ifndef NO_RX_CALLBACK
         cfg->rx_callback = NULL;
+#endif /* NO_RX_CALLBACK */
+#ifndef NO_EMPTY_CALLBACK
         cfg->buff_empty = NULL;
+#endif /* NO_EMPTY_CALLBACK */
+#ifdef MSPIM
+        cfg->spi_mode = 0;
+        cfg->spi_lsb_first = 0;
+        cfg->spi_ubrr = 0;
+        cfg->xfer_complete = NULL;
+#endif /* MSPIM */
+#ifdef MPCM
+        cfg->address = 0;
+        cfg->addr_filter = 0;
+        cfg->addr_callback = NULL;
+#endif /* MPCM */
     }
 };
 
 void init_UART(const struct UARTcfg *cfg)
 {
     cb_init();
-
-    UBRR0H = UBRRH_VALUE; /* set baud rate */
-    UBRR0L = UBRRL_VALUE;
+#ifndef NO_RX_CALLBACK
+    cb.rx_callback = cfg->rx_callback;
+#endif /* NO_RX_CALLBACK */
+#ifndef NO_TX_CALLBACK
+    cb.tx_callback = cfg->tx_callback;
+#endif /* NO_TX_CALLBACK */
+#ifndef NO_EMPTY_CALLBACK
+    cb.buff_empty = cfg->buff_empty;
+#endif /* NO_EMPTY_CALLBACK */
+#ifdef MUX_CHANNELS
+    mux_init();
+#endif
+#ifdef TX_COMPRESS
+    lzss_enc_init(&tx_enc, tx_push);
+#endif
 
 #ifdef PRINTF
     stdout = &uartavr_stdout;
 #endif
 
+#ifdef MSPIM
+    spi_inflight = 0;
+    spi_xfer_complete = cfg->xfer_complete;
+    spi_keep = 0;
+    spi_discard = 0;
+    spi_lost = 0;
+    spi_tail_discard = 0;
+    spi_open = 0;
+
+    /* UBRR0 must be zero when the transmitter is enabled */
+    UBRR0 = 0;
+    /* XCK0 as output selects master mode */
+    DDRD |= _BV(PD4);
+    UCSR0C = _BV(UMSEL01) | _BV(UMSEL00) |
+             ((cfg->spi_mode & 0x02) ? _BV(UCPOL0) : 0) |
+             ((cfg->spi_mode & 0x01) ? _BV(UCPHA0) : 0) |
+             (cfg->spi_lsb_first ? _BV(UDORD0) : 0);
+    /* SPI is always full duplex, we need both directions */
+    UCSR0B = _BV(TXEN0) | _BV(RXEN0) | _BV(RXCIE0);
+#ifndef NO_TX_CALLBACK
+    if (cfg->tx_callback)
+        UCSR0B |= _BV(TXCIE0);
+#endif /* NO_TX_CALLBACK */
+    UBRR0 = cfg->spi_ubrr;
+#else
+    UBRR0H = UBRRH_VALUE; /* set baud rate */
+    UBRR0L = UBRRL_VALUE;
+
 #if USE_2X
     /* U2X-Modus is necessary */
     UCSR0A |= _BV(U2X0);
@@ -170,10 +517,226 @@ void init_UART(const struct UARTcfg *cfg)
     /* 8-bit */
     UCSR0C = _BV(UCSZ01) | _BV(UCSZ00);
     /* as we did not touch UPMn0 UPMn1 and USBSn we are now using 8N1 */
+#ifdef MPCM
+    mpcm_address = cfg->address;
+    mpcm_filter = cfg->addr_filter;
+    mpcm_addr_callback = cfg->addr_callback;
+    /* 9-bit, the 9th bit marks address frames */
+    UCSR0B |= _BV(UCSZ02);
+    /* wait for our address before we take any data */
+    if (mpcm_filter)
+        UCSR0A = (UCSR0A & ~_BV(TXC0)) | _BV(MPCM0);
+#endif /* MPCM */
+#ifdef TX_IDLE_TRACKING
+    /* the TX complete interrupt tells us when the line is idle */
+    tx_idle = 1;
+    UCSR0B |= _BV(TXCIE0);
+#elif !defined(NO_TX_CALLBACK)
+    if (cfg->tx_callback)
+        UCSR0B |= _BV(TXCIE0);
+#endif /* TX_IDLE_TRACKING */
+#ifdef LOW_POWER
+    lp_wakeup = 0;
+    lp_stats.sleeps = 0;
+    lp_stats.wakeups = 0;
+    lp_stats.tx_off = 0;
+#ifdef LOW_POWER_CLOCK
+    lp_stats.idle_ticks = 0;
+    lp_stats.active_ticks = 0;
+    lp_stamp = LOW_POWER_CLOCK;
+#endif /* LOW_POWER_CLOCK */
+    /* keep TXD high while the transmitter is off, tx_start() switches it on */
+    PORTD |= _BV(PD1);
+    DDRD |= _BV(PD1);
+    UCSR0B |= cfg->rx | _BV(RXCIE0);
+#else
     /* activate send, receive plus receive interrupt */
     UCSR0B |= cfg->tx | cfg->rx | _BV(RXCIE0);
+#endif /* LOW_POWER */
+#endif /* MSPIM */
+}
+
+#ifdef BAUD_RUNTIME
+int16_t calc_baud_UART(uint32_t baud, uint16_t *ubrr, uint8_t *use_2x)
+{
+    int32_t best_error = INT32_MAX;
+
+    /*
+     * U2X0 with UBRR0 = 0 is the fastest rate and no U2X0 with UBRR0 = 4095
+     * the slowest. Rejecting everything outside also keeps div * baud and the
+     * error calculation below from overflowing.
+     */
+    if (baud < F_CPU / (16UL * 4096) || baud > F_CPU / 8)
+        return INT16_MAX;
+
+    for (uint8_t u2x = 0; u2x < 2; u2x++) {
+        uint32_t div = u2x ? 8 : 16;
+        uint32_t value = (F_CPU + div * baud / 2) / (div * baud);
+        if (value == 0)
+            value = 1;
+        if (value > 4096)
+            value = 4096;
+        uint32_t actual = (F_CPU + div * value / 2) / (div * value);
+        int32_t error = ((int32_t)actual - (int32_t)baud) * 1000 / (int32_t)baud;
+        if (labs(error) < labs(best_error)) {
+            best_error = error;
+            *ubrr = value - 1;
+            *use_2x = u2x;
+        }
+    }
+
+    if (best_error > INT16_MAX)
+        return INT16_MAX;
+    if (best_error < INT16_MIN)
+        return INT16_MIN;
+    return best_error;
 }
 
+uint8_t set_baud_UART(uint32_t baud, int16_t *error)
+{
+    uint16_t ubrr = 0;
+    uint8_t use_2x = 0;
+    int16_t err = calc_baud_UART(baud, &ubrr, &use_2x);
+
+    if (error)
+        *error = err;
+    if (abs(err) > BAUD_TOL * 10)
+        return 1;
+
+#ifdef TX_COMPRESS
+    flush_UART();
+#endif /* TX_COMPRESS */
+    /* wait until the last frame left the shift register */
+    while ((UCSR0B & _BV(UDRIE0)) || !tx_idle)
+        ;
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-variable"
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#pragma GCC diagnostic pop
+    {
+        UBRR0H = ubrr >> 8;
+        UBRR0L = ubrr & 0xFF;
+        if (use_2x)
+            UCSR0A = (UCSR0A & ~_BV(TXC0)) | _BV(U2X0);
+        else
+            UCSR0A &= ~(_BV(U2X0) | _BV(TXC0));
+    }
+    return 0;
+}
+
+#ifdef AUTOBAUD
+/*
+ * Timer1 overflows are used as time base for the timeout, returns 1 once
+ * *overflows of them passed.
+ */
+static uint8_t autobaud_timeout(uint16_t *overflows)
+{
+    if (TIFR1 & _BV(TOV1)) {
+        TIFR1 = _BV(TOV1);
+        if (*overflows == 0)
+            return 1;
+        (*overflows)--;
+    }
+    return 0;
+}
+
+uint8_t autobaud_UART(uint32_t *baud, uint16_t timeout_ms)
+{
+    uint8_t tccr1a = TCCR1A;
+    uint8_t tccr1b = TCCR1B;
+    uint8_t timsk1 = TIMSK1;
+    uint16_t tcnt1;
+    uint8_t ddrb = DDRB & _BV(PB0);
+    uint8_t rxen = UCSR0B & _BV(RXEN0);
+    uint16_t stamp[5];
+    uint8_t ret = 1;
+    /* timer1 runs without prescaler and overflows every 65536 cycles */
+    uint16_t overflows =
+        ((uint32_t)timeout_ms * (F_CPU / 1000UL)) >> 16;
+
+    UCSR0B &= ~(_BV(RXEN0));
+    DDRB &= ~(_BV(PB0));
+
+    /* Timer1 ISRs would clear the flags that are polled here */
+    TIMSK1 = 0;
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-variable"
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#pragma GCC diagnostic pop
+    {
+        tcnt1 = TCNT1;
+    }
+    /* normal mode, no prescaler, noise canceler, capture falling edges */
+    TCCR1A = 0;
+    TCCR1B = _BV(ICNC1) | _BV(CS10);
+    TIFR1 = _BV(ICF1) | _BV(TOV1);
+
+    /*
+     * 0x55 on the wire (LSB first): start 1 0 1 0 1 0 1 0 stop. There is
+     * a falling edge at the start bit and at every odd data bit, two bit
+     * times apart.
+     */
+    uint8_t edge;
+    for (edge = 0; edge < 5; edge++) {
+        while (!(TIFR1 & _BV(ICF1)) && !autobaud_timeout(&overflows))
+            ;
+        if (!(TIFR1 & _BV(ICF1)))
+            break;
+        /* 16 bit register access shares the TEMP register with ISRs */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-variable"
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#pragma GCC diagnostic pop
+        {
+            stamp[edge] = ICR1;
+        }
+        TIFR1 = _BV(ICF1);
+    }
+
+    if (edge == 5) {
+        /* the fourth edge after the start bit is eight bit times later */
+        uint16_t ticks = stamp[4] - stamp[0];
+        uint32_t min = ticks - ticks / 4;
+        uint32_t max = (uint32_t)ticks + ticks / 4;
+        ret = ticks == 0;
+        for (uint8_t i = 0; i < 4 && !ret; i++) {
+            /* every interval has to be 2 bit times +-25 % */
+            uint32_t interval = (uint16_t)(stamp[i + 1] - stamp[i]) * 4UL;
+            if (interval < min || interval > max)
+                ret = 1;
+        }
+        /* let the stop bit pass before the receiver is switched on again */
+        while (!ret && !(PIND & _BV(PD0)))
+            ret = autobaud_timeout(&overflows);
+        if (!ret) {
+            uint32_t measured = (F_CPU * 8UL + ticks / 2) / ticks;
+            if (baud)
+                *baud = measured;
+            ret = set_baud_UART(measured, NULL);
+        }
+    }
+
+    TCCR1B = 0;
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-variable"
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#pragma GCC diagnostic pop
+    {
+        TCNT1 = tcnt1;
+    }
+    /* do not let the application see our flags */
+    TIFR1 = _BV(ICF1) | _BV(TOV1);
+    TCCR1A = tccr1a;
+    TCCR1B = tccr1b;
+    TIMSK1 = timsk1;
+    DDRB |= ddrb;
+    UCSR0B |= rxen;
+    return ret;
+}
+#endif /* AUTOBAUD */
+#endif /* BAUD_RUNTIME */
+
 #ifdef LIB_DEBUG
 
 void put_noi_UART(char c)
@@ -181,6 +744,9 @@ void put_noi_UART(char c)
     /* Stay here until data buffer is empty */
     while (!(UCSR0A & _BV(UDRE0)))
         ;
+#ifdef MPCM
+    UCSR0B &= ~(_BV(TXB80));
+#endif /* MPCM */
     /* write data */
     UDR0 = c;
 }
@@ -201,12 +767,23 @@ void puts_noi_UART(const char *s)
 
 void put_UART(const char c)
 {
+#ifdef MUX_CHANNELS
+    put_mux_UART(0, c);
+#elif defined(TX_COMPRESS)
+    lzss_enc_put(&tx_enc, c);
+#elif defined(MSPIM)
+    spi_transfer_UART(&c, 1);
+#else
     if (cb_push(c, TX_BUFF) == 0)
-        UCSR0B |= _BV(UDRIE0); /* activate buffer empty interrupt */
+        tx_start();
+#endif /* MUX_CHANNELS */
 }
 
 void puts_UART(const char *s)
 {
+#ifdef MUX_CHANNELS
+    puts_mux_UART(0, s);
+#else
     while (*s) {
         put_UART(*s);
         s++;
@@ -216,18 +793,33 @@ void puts_UART(const char *s)
         put_UART(*cr_ptr);
         cr_ptr++;
     }
+#ifdef TX_COMPRESS
+    flush_UART();
+#endif
+#endif /* MUX_CHANNELS */
 }
 
+#ifdef TX_COMPRESS
+void flush_UART(void) { lzss_enc_flush(&tx_enc); }
+#endif /* TX_COMPRESS */
+
 uint8_t get_UART(char *s)
 {
+#ifdef MUX_CHANNELS
+    return get_mux_UART(0, s);
+#else
     char *s_ptr = s;
     if (cb_pop(s_ptr, RX_BUFF) == 0)
         return 0;
     return 1;
+#endif /* MUX_CHANNELS */
 }
 
 uint8_t gets_UART(char *s)
 {
+#ifdef MUX_CHANNELS
+    return gets_mux_UART(0, s);
+#else
     char *s_ptr = s;
     if (cb.rx_buff.items > 0) {
         while ((cb_pop(s_ptr, RX_BUFF) == 0)) {
@@ -239,8 +831,219 @@ uint8_t gets_UART(char *s)
         *s_ptr = '\0';
         return 1;
     }
+#endif /* MUX_CHANNELS */
+}
+
+#ifdef MSPIM
+static void spi_start(void)
+{
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-variable"
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#pragma GCC diagnostic pop
+    {
+        /* otherwise the RX ISR activates it once a byte came back */
+        if (spi_inflight < 2)
+            UCSR0B |= _BV(UDRIE0); /* activate buffer empty interrupt */
+    }
+}
+
+size_t spi_transfer_UART(const char *data, size_t len)
+{
+    size_t queued = 0;
+    spi_tail_discard = 0;
+    while (queued < len && cb_push(data[queued], TX_BUFF) == 0)
+        queued++;
+    if (queued)
+        spi_start();
+    return queued;
+}
+
+size_t spi_write_UART(const char *data, size_t len)
+{
+    size_t queued = 0;
+    uint8_t ready = 0;
+
+    /*
+     * Only one discarded stretch can be tracked. If bytes that must be kept
+     * were queued behind it, wait until it has been clocked out.
+     */
+    while (!ready) {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-variable"
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#pragma GCC diagnostic pop
+        {
+            if (spi_discard == 0) {
+                /* everything queued so far is still stored */
+                spi_keep = spi_inflight + cb.tx_buff.items;
+                ready = 1;
+            } else if (spi_tail_discard) {
+                ready = 1;
+            }
+        }
+    }
+    spi_tail_discard = 1;
+
+    while (queued < len) {
+        /* count the byte first, the ISR may receive it right away */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-variable"
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#pragma GCC diagnostic pop
+        {
+            spi_discard++;
+        }
+        if (cb_push(data[queued], TX_BUFF) != 0) {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-variable"
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#pragma GCC diagnostic pop
+            {
+                spi_discard--;
+            }
+            break;
+        }
+        queued++;
+    }
+    if (queued)
+        spi_start();
+    return queued;
+}
+
+uint16_t spi_lost_UART(void)
+{
+    uint16_t lost;
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-variable"
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#pragma GCC diagnostic pop
+    {
+        lost = spi_lost;
+        spi_lost = 0;
+    }
+    return lost;
+}
+
+void spi_begin_UART(void) { spi_open = 1; }
+
+void spi_commit_UART(void)
+{
+    uint8_t done;
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-variable"
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#pragma GCC diagnostic pop
+    {
+        spi_open = 0;
+        /* otherwise the RX ISR calls it after the last byte */
+        done = spi_inflight == 0 && cb.tx_buff.items == 0;
+    }
+    if (done && spi_xfer_complete)
+        spi_xfer_complete();
 }
 
+uint8_t spi_busy_UART(void)
+{
+    uint8_t busy;
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-variable"
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#pragma GCC diagnostic pop
+    {
+        busy = spi_open || spi_inflight || cb.tx_buff.items;
+    }
+    return busy;
+}
+#endif /* MSPIM */
+
+#ifdef MPCM
+void address_UART(uint8_t addr)
+{
+#ifdef TX_COMPRESS
+    /* the old node has to get everything that was written for it */
+    flush_UART();
+    /*
+     * A filtering node never saw what was sent to other addresses, back
+     * references must not point into that history.
+     */
+    lzss_enc_init(&tx_enc, tx_push);
+#endif /* TX_COMPRESS */
+    /* the UDRE ISR deactivates itself when there is nothing left to send */
+    while (UCSR0B & _BV(UDRIE0))
+        ;
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-variable"
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#pragma GCC diagnostic pop
+    {
+        while (!(UCSR0A & _BV(UDRE0)))
+            ;
+        /* the UDRE ISR clears TXB80 again before the next data byte */
+#ifdef LOW_POWER
+        UCSR0B |= _BV(TXEN0) | _BV(TXB80);
+#else
+        UCSR0B |= _BV(TXB80);
+#endif /* LOW_POWER */
+        UDR0 = addr;
+#ifdef TX_IDLE_TRACKING
+        tx_idle = 0;
+#endif /* TX_IDLE_TRACKING */
+#ifdef MUX_CHANNELS
+        /* the new node does not know our current channel */
+        mux.tx_chan = MUX_ESC;
+#endif /* MUX_CHANNELS */
+    }
+}
+#endif /* MPCM */
+
+#ifdef LOW_POWER
+void wait_idle_UART(void)
+{
+    set_sleep_mode(SLEEP_MODE_IDLE);
+
+    cli();
+#ifdef LOW_POWER_CLOCK
+    uint16_t now = LOW_POWER_CLOCK;
+    lp_stats.active_ticks += (uint16_t)(now - lp_stamp);
+    lp_stamp = now;
+#endif /* LOW_POWER_CLOCK */
+    while (!lp_wakeup) {
+        /*
+         * sei() delays interrupts by one instruction, so an interrupt can not
+         * slip in between checking lp_wakeup and going to sleep.
+         */
+        sleep_enable();
+        sei();
+        sleep_cpu();
+        sleep_disable();
+        cli();
+        lp_stats.sleeps++;
+#ifdef LOW_POWER_CLOCK
+        now = LOW_POWER_CLOCK;
+        lp_stats.idle_ticks += (uint16_t)(now - lp_stamp);
+        lp_stamp = now;
+#endif /* LOW_POWER_CLOCK */
+    }
+    lp_wakeup = 0;
+    lp_stats.wakeups++;
+    sei();
+}
+
+void notify_UART(void) { lp_wakeup = 1; }
+
+void get_power_stats_UART(struct PowerStats *stats)
+{
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-variable"
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#pragma GCC diagnostic pop
+    {
+        *stats = lp_stats;
+    }
+}
+#endif /* LOW_POWER */
+
 #ifdef PRINTF
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-parameter"
@@ -252,6 +1055,9 @@ int puts_printf_UART(char c, FILE *stream)
 #ifdef CR_PRINTF
         put_UART(*CR_PRINTF);
 #endif /* CR_PRINTF */
+#ifdef TX_COMPRESS
+        flush_UART();
+#endif
     }
     return 0;
 }
@@ -259,25 +1065,111 @@ int puts_printf_UART(char c, FILE *stream)
 
 ISR(USART_RX_vect)
 {
+#ifdef MPCM
+    /* RXB80 has to be read before UDR0 */
+    if (UCSR0B & _BV(RXB80)) {
+        uint8_t addr = UDR0;
+        if (!mpcm_filter)
+            return;
+        if (addr == mpcm_address || addr == MPCM_BROADCAST) {
+            /* take the data frames that follow */
+            UCSR0A &= ~(_BV(MPCM0) | _BV(TXC0));
+#ifdef MUX_CHANNELS
+            mux.rx_chan = 0;
+            mux.rx_esc = 0;
+#endif /* MUX_CHANNELS */
+            if (mpcm_addr_callback)
+                mpcm_addr_callback();
+        } else {
+            /* not for us, sleep until the next address frame */
+            UCSR0A = (UCSR0A & ~_BV(TXC0)) | _BV(MPCM0);
+        }
+        return;
+    }
+#endif /* MPCM */
+#ifdef MUX_CHANNELS
+    mux_rx_byte(UDR0);
+#elif defined(MSPIM)
+    char c = UDR0;
+    if (spi_keep) {
+        spi_keep--;
+        if (cb_push(c, RX_BUFF) != 0)
+            spi_lost++;
+    } else if (spi_discard) {
+        /* answer to spi_write_UART(), nobody wants it */
+        spi_discard--;
+    } else if (cb_push(c, RX_BUFF) != 0) {
+        spi_lost++;
+    }
+#else
     cb_push(UDR0, RX_BUFF);
-    if (cb.rx_buff.rx_callback)
-        cb.rx_buff.rx_callback();
+#endif
+#ifdef MSPIM
+    /*
+     * The receiver only has a two byte FIFO. We keep at most two bytes in
+     * flight and let every received byte release the next one so a slow ISR
+     * can never cause a data overrun, no matter how fast SCK is.
+     */
+    spi_inflight--;
+    if (cb.tx_buff.items) {
+        UCSR0B |= _BV(UDRIE0);
+    } else if (spi_inflight == 0 && !spi_open && spi_xfer_complete) {
+        spi_xfer_complete();
+    }
+#endif /* MSPIM */
+#ifdef LOW_POWER
+    lp_wakeup = 1;
+#endif /* LOW_POWER */
+#ifndef NO_RX_CALLBACK
+    if (cb.rx_callback)
+        cb.rx_callback();
+#endif /* NO_RX_CALLBACK */
 }
 
+#if defined(TX_IDLE_TRACKING) || !defined(NO_TX_CALLBACK)
 ISR(USART_TX_vect)
 {
-    if (cb.tx_buff.tx_callback)
-        cb.tx_buff.tx_callback();
+#ifdef TX_IDLE_TRACKING
+    tx_idle = 1;
+#endif /* TX_IDLE_TRACKING */
+#ifdef LOW_POWER
+    /* buffer drained, PD1 keeps the line high while the transmitter is off */
+    if (!(UCSR0B & _BV(UDRIE0))) {
+        UCSR0B &= ~(_BV(TXEN0));
+        lp_stats.tx_off++;
+    }
+#endif /* LOW_POWER */
+#ifndef NO_TX_CALLBACK
+    if (cb.tx_callback)
+        cb.tx_callback();
+#endif /* NO_TX_CALLBACK */
 }
+#endif /* TX_IDLE_TRACKING || !NO_TX_CALLBACK */
 
 ISR(USART_UDRE_vect)
 {
     char c = 0;
+#ifdef MUX_CHANNELS
+    if (mux_next_tx(&c) != 0) {
+#else
     if (cb_pop(&c, TX_BUFF) != 0) {
+#endif
         UCSR0B &= ~(_BV(UDRIE0));
-        if (cb.tx_buff.buff_empty)
-            cb.tx_buff.buff_empty();
+#ifndef NO_EMPTY_CALLBACK
+        if (cb.buff_empty)
+            cb.buff_empty();
+#endif /* NO_EMPTY_CALLBACK */
     } else {
+#ifdef MPCM
+        UCSR0B &= ~(_BV(TXB80));
+#endif /* MPCM */
         UDR0 = c;
+#ifdef TX_IDLE_TRACKING
+        tx_idle = 0;
+#endif /* TX_IDLE_TRACKING */
+#ifdef MSPIM
+        if (++spi_inflight == 2)
+            UCSR0B &= ~(_BV(UDRIE0));
+#endif /* MSPIM */
     }
 }
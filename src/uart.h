@@ -58,6 +58,10 @@
 #include <util/atomic.h>
 #include <util/setbaud.h>
 
+#ifdef TX_COMPRESS
+#include "lzss.h"
+#endif
+
 /**
  * @file uart.h
  *
@@ -74,6 +78,31 @@
  * or was received. In general the user does not have to interact directly with
  * this buffer as there are some convenience methods already available.
  *
+ * If you define MUX_CHANNELS the serial line is shared by MUX_CHANNELS logical
+ * channels. Every channel has its own RX and TX queue and the TX ISR schedules
+ * the channels in a weighted round robin fashion. put_UART(), puts_UART(),
+ * get_UART() and gets_UART() then operate on channel 0.
+ *
+ * If you define TX_COMPRESS everything written with put_UART(), puts_UART() or
+ * printf is compressed with a small streaming LZSS encoder (see lzss.h) before
+ * it enters the TX buffer. Add lzss.c to your sources in this case. The host
+ * has to decompress the stream, the `tools` subfolder has a decompressor.
+ *
+ * If you define MPCM the library uses 9 bit frames and the multi-processor
+ * communication mode of the USART for multidrop buses like RS-485, see
+ * address_UART().
+ *
+ * If you define BAUD_RUNTIME the baud rate can be changed after init_UART() with
+ * set_baud_UART(). AUTOBAUD adds autobaud_UART() which measures the rate of
+ * the host.
+ *
+ * If you define LOW_POWER the transmitter is switched off whenever the TX buffer
+ * has been sent completely and wait_idle_UART() lets the CPU sleep until there
+ * is something to do. TXD (PD1) is driven high while the transmitter is off.
+ *
+ * If you define MSPIM the USART runs in Master SPI Mode. The same buffers and
+ * ISRs are used, see spi_transfer_UART().
+ *
  * In order to use this implementation you have to use [sei](http://www.nongnu.org/avr-libc/user-manual/group__avr__interrupts.html#gaad5ebd34cb344c26ac87594f79b06b73)
  * which enables interrupts by setting the global interrupt mask.
  *
@@ -110,7 +139,30 @@
 /**
  * @brief The buffer size for the RX and TX buffers
  */
+#ifndef BUFFSIZE
 #define BUFFSIZE 64
+#endif /* ifndef BUFFSIZE */
+
+/**
+ * @brief Define this to remove all callback pointers and the indirect calls in
+ * the ISRs. Same as defining NO_RX_CALLBACK, NO_TX_CALLBACK and
+ * NO_EMPTY_CALLBACK.
+ */
+#ifdef NO_CALLBACKS
+#define NO_RX_CALLBACK
+#define NO_TX_CALLBACK
+#define NO_EMPTY_CALLBACK
+#endif /* NO_CALLBACKS */
+
+/**
+ * @brief Index type of the circular buffers, one byte as long as BUFFSIZE
+ * allows it
+ */
+#if BUFFSIZE < 256
+typedef uint8_t buff_index_t;
+#else
+typedef uint16_t buff_index_t;
+#endif
 
 /**
  * @brief Presenting a circular buffer
@@ -121,19 +173,12 @@
  * read functions are not blocking.
  */
 struct DirBuff {
-    char buff[BUFFSIZE];       /**< The buffer holding the data that should be
-                                 send or was received */
-    char *start_ptr;           /**< A pointer to the start of the buffer */
-    char *end_ptr;             /**< A pointer to theend of the buffer */
-    char *inpos_ptr;           /**< The write pointer position */
-    char *outpos_ptr;          /**< The read pointer position */
-    size_t items;              /**< Number of items in the buffer */
-    uint8_t full;              /**< Indicates if the buffer is full, meaning BUFFSIZE
-                                 number of items are stored */
-    void (*rx_callback)(void); /**< A callback function you can use to get
-                                 notified if a byte was received */
-    void (*tx_callback)(void); /**< Callback when a byte was sent */
-    void (*buff_empty)(void);  /**< Callback when buff is empty */
+    char buff[BUFFSIZE];  /**< The buffer holding the data that should be
+                            send or was received */
+    buff_index_t inpos;   /**< The write position */
+    buff_index_t outpos;  /**< The read position */
+    buff_index_t items;   /**< Number of items in the buffer, BUFFSIZE means
+                            the buffer is full */
 };
 
 /**
@@ -145,12 +190,36 @@ enum DIR_BUFFS {
 };
 
 /**
- * @brief This holds the circular buffers
+ * @brief This holds the circular buffers and the callbacks of the ISRs
+ *
+ * @details
+ * Every callback can be removed at compile time with NO_RX_CALLBACK,
+ * NO_TX_CALLBACK, NO_EMPTY_CALLBACK or NO_CALLBACKS. The ISRs do not check or
+ * call them then.
  */
 struct CBuffer {
-    struct DirBuff rx_buff; /**< RX Buffer */
-    struct DirBuff tx_buff; /**< TX Buffer */
-} cb;                       /**< Global instance of the circular buffer */
+#ifndef MUX_CHANNELS
+    struct DirBuff rx_buff;    /**< RX Buffer, replaced by Mux with
+                                 MUX_CHANNELS */
+    struct DirBuff tx_buff;    /**< TX Buffer, replaced by Mux with
+                                 MUX_CHANNELS */
+#endif /* MUX_CHANNELS */
+#ifndef NO_RX_CALLBACK
+    void (*rx_callback)(void); /**< A callback function you can use to get
+                                 notified if a byte was received */
+#endif /* NO_RX_CALLBACK */
+#ifndef NO_TX_CALLBACK
+    void (*tx_callback)(void); /**< Callback when the last byte was sent */
+#endif /* NO_TX_CALLBACK */
+#ifndef NO_EMPTY_CALLBACK
+    void (*buff_empty)(void);  /**< Callback when the TX buffer is empty */
+#endif /* NO_EMPTY_CALLBACK */
+};
+
+/**
+ * @brief Global instance of the circular buffer, defined in uart.c
+ */
+extern struct CBuffer cb;
 
 /* TODO: I am not sure if this instance of CBuffer needs to be volatile. But if I
 *  do this I get lots of compiler warnings.
@@ -164,12 +233,34 @@ struct CBuffer {
 struct UARTcfg {
     uint8_t tx; /**< Activate TX, use the appropriate Byte for your platform */
     uint8_t rx; /**< Activate RX, use the appropriate Byte for your platform */
+#ifndef NO_RX_CALLBACK
     void (*rx_callback)(void); /**< Callback function that will be called from
                                  RX ISR */
+#endif /* NO_RX_CALLBACK */
+#ifndef NO_TX_CALLBACK
     void (*tx_callback)(void); /**< Callback function that will be called from
                                  TX ISR */
+#endif /* NO_TX_CALLBACK */
+#ifndef NO_EMPTY_CALLBACK
     void (*buff_empty)(void);  /**< Callback function that will be called from
-                                 RX ISR */
+                                 UDRE ISR */
+#endif /* NO_EMPTY_CALLBACK */
+#ifdef MSPIM
+    uint8_t spi_mode;      /**< SPI mode 0..3, bit 1 is CPOL and bit 0 CPHA */
+    uint8_t spi_lsb_first; /**< Shift out the LSB first if not 0 */
+    uint16_t spi_ubrr;     /**< Clock divider, SCK runs with
+                             F_CPU / (2 * (spi_ubrr + 1)) */
+    void (*xfer_complete)(void); /**< Callback function that will be called from
+                                   RX ISR when all queued bytes have been
+                                   exchanged, see spi_begin_UART() */
+#endif /* MSPIM */
+#ifdef MPCM
+    uint8_t address;     /**< Address of this node on the bus */
+    uint8_t addr_filter; /**< If not 0 only data that follows an address frame
+                           with UARTcfg#address or MPCM_BROADCAST is received */
+    void (*addr_callback)(void); /**< Callback function that will be called
+                                   from RX ISR when this node was addressed */
+#endif /* MPCM */
 };
 
 /**
@@ -180,6 +271,8 @@ struct UARTcfg {
  */
 void cb_init(void);
 
+#ifndef MUX_CHANNELS
+
 /**
  * @brief Get a direction buffer struct from CBuffer
  *
@@ -205,7 +298,9 @@ uint8_t cb_pop(char *c, enum DIR_BUFFS dir);
  *
  * @return 0 If the byte has written successfully, 1 if the buffer is full
  */
-uint8_t cp_push(char c, enum DIR_BUFFS dir);
+uint8_t cb_push(char c, enum DIR_BUFFS dir);
+
+#endif /* MUX_CHANNELS */
 
 /**
  * @brief Init a cfg struct with the default values
@@ -223,12 +318,287 @@ void init_uart_cfg(struct UARTcfg *cfg);
  * Some configuration options are currently fixed. The UART will always be setup
  * in 8N1 mode. This may be changed in the future.
  *
+ * If MPCM is defined the frame format is 9N1 instead. Address frames have the
+ * 9th bit set and are never stored in the RX buffer. With UARTcfg#addr_filter
+ * the Multi-processor Communication Mode is activated so the RX ISR is only
+ * executed for data that is addressed to this node.
+ *
+ * If MSPIM is defined the USART is set up as SPI master instead, XCK0 (PD4) is
+ * the clock output. TX and RX are both enabled as every transmitted byte
+ * receives one, UARTcfg#tx and UARTcfg#rx are ignored. UARTcfg#tx_callback is
+ * called from the TX ISR whenever the shift register ran empty.
+ *
  * This method also initializes a circular buffer. So there is no need to call
- * cb_init() yourself.
+ * cb_init() yourself. The callbacks of cfg are copied to #cb, you may also set
+ * them there later on.
  *
  */
 void init_UART(const struct UARTcfg *cfg);
 
+#ifdef MSPIM
+
+#if defined(MUX_CHANNELS) || defined(TX_COMPRESS)
+#error "MSPIM can not be combined with MUX_CHANNELS or TX_COMPRESS"
+#endif
+
+#ifdef LIB_DEBUG
+#error "LIB_DEBUG can not be combined with MSPIM"
+#endif
+
+/**
+ * @brief Queue bytes for a SPI transfer
+ *
+ * @param data The bytes to shift out. Use dummy bytes if you only want to read.
+ * @param len Number of bytes
+ *
+ * @return Number of bytes that were queued. This is less than len if the TX
+ * buffer ran full.
+ *
+ * @details
+ * For every byte that is shifted out one byte is shifted in and stored in the
+ * RX buffer. Use get_UART() or gets_UART() to fetch them. When the last queued
+ * byte has been exchanged UARTcfg#xfer_complete is called, this is the place
+ * to deassert the chip select of your slave. The TX buffer may run empty
+ * between two calls, wrap them in spi_begin_UART() and spi_commit_UART() if
+ * they belong to the same transaction.
+ *
+ * @warning The RX buffer holds BUFFSIZE bytes. For longer transfers you have
+ * to drain it with get_UART() while the transfer is running (e.g. from
+ * CBuffer#rx_callback), otherwise received bytes are lost, see spi_lost_UART().
+ * Use spi_write_UART() if you do not need the answer.
+ */
+size_t spi_transfer_UART(const char *data, size_t len);
+
+/**
+ * @brief Queue bytes for a SPI transfer and throw the answer away
+ *
+ * @param data The bytes to shift out
+ * @param len Number of bytes
+ *
+ * @return Number of bytes that were queued
+ *
+ * @details
+ * Works like spi_transfer_UART() but the bytes received while data is shifted
+ * out do not end up in the RX buffer. Use this for commands and page writes so
+ * the RX buffer only holds the data you actually read.
+ *
+ * Only one discarded stretch is tracked at a time. If spi_transfer_UART() was
+ * called after the last spi_write_UART() and that stretch is still being
+ * sent, this function waits until it is done. Interrupts must be enabled.
+ */
+size_t spi_write_UART(const char *data, size_t len);
+
+/**
+ * @brief Number of received bytes that were lost because the RX buffer was full
+ *
+ * @return The count since the last call, the counter is reset
+ */
+uint16_t spi_lost_UART(void);
+
+/**
+ * @brief Start a transaction that spans several transfer calls
+ *
+ * @details
+ * Until spi_commit_UART() is called UARTcfg#xfer_complete is not called, even
+ * if the TX buffer runs empty between two spi_transfer_UART() or
+ * spi_write_UART() calls. The bytes are shifted out as soon as they are
+ * queued, a transaction may therefore be longer than BUFFSIZE.
+ *
+ * @code
+ * spi_begin_UART();
+ * spi_write_UART(&cmd, 1);
+ * spi_transfer_UART(dummy, 3);
+ * spi_commit_UART();
+ * @endcode
+ */
+void spi_begin_UART(void);
+
+/**
+ * @brief End a transaction started with spi_begin_UART()
+ *
+ * @details
+ * UARTcfg#xfer_complete is called from the RX ISR once the last queued byte
+ * has been exchanged. If that already happened it is called right away from
+ * this function.
+ */
+void spi_commit_UART(void);
+
+/**
+ * @brief Check if a SPI transfer is in progress
+ *
+ * @return 1 while bytes are queued or on the wire or a transaction has not been
+ * committed yet, 0 otherwise
+ */
+uint8_t spi_busy_UART(void);
+
+#endif /* MSPIM */
+
+#ifdef MPCM
+
+#ifdef MSPIM
+#error "MPCM can not be combined with MSPIM"
+#endif
+
+/**
+ * @brief Address frames with this address are accepted by every node
+ */
+#ifndef MPCM_BROADCAST
+#define MPCM_BROADCAST 0xFF
+#endif /* ifndef MPCM_BROADCAST */
+
+/**
+ * @brief Send an address frame (9th bit set)
+ *
+ * @param addr The address of the node the following data is meant for
+ *
+ * @details
+ * Data written after this call is sent as data frames and only received by
+ * the addressed node. The function waits until all data queued so far has been
+ * handed to the USART, so the address frame can not overtake it. Interrupts
+ * must be enabled.
+ *
+ * With TX_COMPRESS the encoder is flushed and reset, the compressed stream
+ * starts over after every address frame. Receivers have to reset their
+ * decoder (lzss_dec_init()) whenever they see an address frame.
+ */
+void address_UART(uint8_t addr);
+
+#endif /* MPCM */
+
+#if defined(AUTOBAUD) && !defined(BAUD_RUNTIME)
+#define BAUD_RUNTIME
+#endif
+
+#ifdef BAUD_RUNTIME
+
+#ifdef MSPIM
+#error "BAUD_RUNTIME can not be combined with MSPIM, use UARTcfg#spi_ubrr"
+#endif
+
+/**
+ * @brief Calculate the UBRR value and U2X setting for a baud rate
+ *
+ * @param baud The requested baud rate
+ * @param ubrr Pointer to a variable that receives the UBRR0 value
+ * @param use_2x Pointer to a variable that receives 1 if U2X0 must be set
+ *
+ * @return The error of the resulting baud rate in 0.1 % (20 means 2.0 %). The
+ * mode without U2X0 is preferred as long as it is at least as accurate.
+ * INT16_MAX if baud is slower than F_CPU / 65536 (UBRR0 = 4095) or faster
+ * than F_CPU / 8 (U2X0 and UBRR0 = 0), ubrr and use_2x are not touched in this
+ * case.
+ */
+int16_t calc_baud_UART(uint32_t baud, uint16_t *ubrr, uint8_t *use_2x);
+
+/**
+ * @brief Change the baud rate at runtime
+ *
+ * @param baud The new baud rate
+ * @param error Pointer to a variable that receives the error in 0.1 %, may be
+ * NULL
+ *
+ * @return 0 on success, 1 if the error exceeds BAUD_TOL percent. The baud rate
+ * is not changed in this case.
+ *
+ * @details
+ * The function waits until the TX buffer is empty and the last frame has left
+ * the shift register, so nothing that was written before is sent with the
+ * new rate. Interrupts must be enabled. Data that is being received while the
+ * rate is changed will be garbage.
+ */
+uint8_t set_baud_UART(uint32_t baud, int16_t *error);
+
+#ifdef AUTOBAUD
+
+/**
+ * @brief Measure the baud rate of the host and switch to it
+ *
+ * @param baud Pointer to a variable that receives the measured baud rate, may
+ * be NULL
+ * @param timeout_ms Give up after roughly this many milliseconds, the
+ * resolution is 65536 CPU cycles (4 ms at 16MHz)
+ *
+ * @return 0 on success, 1 on timeout, if the edges did not look like a sync
+ * character or if the measured rate can not be set
+ *
+ * @details
+ * The host has to send the sync character `U` (0x55). Its falling edges are
+ * timestamped with the input capture unit of Timer1, the time between the
+ * start bit and the last data bit gives the bit width. ICP1 (PB0) must be
+ * connected to RXD (PD0) for this to work.
+ *
+ * The function blocks until a sync character was seen or the timeout expired.
+ * The four intervals between the falling edges must all be about two bit times,
+ * anything else is rejected. The receiver is switched off during the
+ * measurement so the sync character does not end up in the RX buffer. Timer1
+ * is used without prescaler and its interrupts are disabled during the
+ * measurement. The Timer1 configuration, TCNT1, TIMSK1 and the direction of PB0
+ * are restored afterwards, pending ICF1 and TOV1 flags are cleared. The time
+ * spent in this function is missing from TCNT1.
+ * Baud rates below F_CPU * 8 / 65536 (about 1950 at 16MHz) can not be
+ * measured.
+ */
+uint8_t autobaud_UART(uint32_t *baud, uint16_t timeout_ms);
+
+#endif /* AUTOBAUD */
+
+#endif /* BAUD_RUNTIME */
+
+#ifdef LOW_POWER
+
+#ifdef MSPIM
+#error "LOW_POWER can not be combined with MSPIM"
+#endif
+
+/**
+ * @brief Counters kept by the low power mode
+ *
+ * @details
+ * The tick counters are only available if LOW_POWER_CLOCK is defined as an
+ * expression that returns a free running 16 bit counter, e.g. `TCNT1`. The
+ * timer must not wrap during a single interval. An overflow interrupt of that
+ * timer limits the sleep intervals, the time between two calls of
+ * wait_idle_UART() is your responsibility.
+ */
+struct PowerStats {
+    uint32_t sleeps;       /**< How often the CPU entered the idle sleep mode */
+    uint32_t wakeups;      /**< How often wait_idle_UART() returned */
+    uint32_t tx_off;       /**< How often the transmitter was switched off */
+#ifdef LOW_POWER_CLOCK
+    uint32_t idle_ticks;   /**< LOW_POWER_CLOCK ticks spent sleeping */
+    uint32_t active_ticks; /**< LOW_POWER_CLOCK ticks spent outside of
+                             wait_idle_UART() */
+#endif /* LOW_POWER_CLOCK */
+};
+
+/**
+ * @brief Sleep in idle mode until data or a notification arrives
+ *
+ * @details
+ * Returns as soon as a byte was received or notify_UART() was called since
+ * the last return. Other interrupts wake the CPU as well but it goes back to
+ * sleep right away. Interrupts are enabled when this function returns.
+ */
+void wait_idle_UART(void);
+
+/**
+ * @brief Make wait_idle_UART() return
+ *
+ * @details
+ * Call this from your own ISRs (e.g. a timer) when the main loop has work to
+ * do.
+ */
+void notify_UART(void);
+
+/**
+ * @brief Get a copy of the low power counters
+ *
+ * @param stats Pointer to a PowerStats struct
+ */
+void get_power_stats_UART(struct PowerStats *stats);
+
+#endif /* LOW_POWER */
+
 #ifdef LIB_DEBUG
 void put_noi_UART(char c);
 void puts_noi_UART(const char *s);
@@ -273,6 +643,207 @@ uint8_t get_UART(char *s);
  */
 uint8_t gets_UART(char *s);
 
+#ifdef TX_COMPRESS
+
+#ifdef MUX_CHANNELS
+#error "TX_COMPRESS can not be combined with MUX_CHANNELS"
+#endif
+
+/**
+ * @brief Push all data that is held back by the compressor into the TX buffer
+ *
+ * @details
+ * The compressor keeps up to LZSS_MAX_MATCH bytes to look for repetitions.
+ * puts_UART() and puts_printf_UART() (on newline) flush automatically.
+ *
+ * @warning With TX_COMPRESS the library waits for room in the TX buffer
+ * instead of dropping bytes as dropping would corrupt the compressed stream.
+ * Interrupts must be enabled when you write data.
+ */
+void flush_UART(void);
+
+#endif /* TX_COMPRESS */
+
+#ifdef MUX_CHANNELS
+
+/**
+ * @brief Size of the per channel RX and TX queues, must not exceed 255
+ */
+#ifndef MUX_BUFFSIZE
+#define MUX_BUFFSIZE 16
+#endif /* ifndef MUX_BUFFSIZE */
+
+#if MUX_BUFFSIZE > 255
+#error "MUX_BUFFSIZE must not exceed 255"
+#endif
+
+/**
+ * @brief Escape byte that introduces a channel switch on the wire
+ *
+ * @details
+ * The byte sequence `MUX_ESC n` tells the receiver that all following bytes
+ * belong to channel `n`. A data byte equal to MUX_ESC is sent as `MUX_ESC
+ * MUX_ESC`. MUX_ESC must therefore be greater or equal to MUX_CHANNELS.
+ */
+#ifndef MUX_ESC
+#define MUX_ESC 0x10
+#endif /* ifndef MUX_ESC */
+
+/**
+ * @brief Default number of bytes a channel may send before the scheduler moves
+ * on to the next channel
+ */
+#ifndef MUX_WEIGHT
+#define MUX_WEIGHT 4
+#endif /* ifndef MUX_WEIGHT */
+
+#if MUX_ESC < MUX_CHANNELS
+#error "MUX_ESC must not be a valid channel number"
+#endif
+
+/**
+ * @brief A small circular buffer used by a logical channel
+ */
+struct MuxBuff {
+    char buff[MUX_BUFFSIZE]; /**< The buffer holding the data */
+    buff_index_t inpos;      /**< The write index */
+    buff_index_t outpos;     /**< The read index */
+    buff_index_t items;      /**< Number of items in the buffer */
+};
+
+/**
+ * @brief A logical channel with its own RX and TX queue
+ */
+struct MuxChannel {
+    struct MuxBuff rx_buff;    /**< RX queue of this channel */
+    struct MuxBuff tx_buff;    /**< TX queue of this channel */
+    uint8_t weight;            /**< Bytes this channel may send in a row */
+#ifndef NO_RX_CALLBACK
+    void (*rx_callback)(void); /**< Called from RX ISR when this channel
+                                 received a byte */
+#endif /* NO_RX_CALLBACK */
+};
+
+/**
+ * @brief Holds all logical channels and the state of the framing engine
+ */
+struct Mux {
+    struct MuxChannel chan[MUX_CHANNELS]; /**< The logical channels */
+    uint8_t tx_chan;   /**< Channel the receiver currently expects */
+    uint8_t tx_credit; /**< Bytes tx_chan may still send in its turn */
+    uint8_t tx_esc;    /**< Number of pending bytes in tx_esc_byte */
+    char tx_esc_byte;  /**< Second byte of an escape sequence */
+    uint8_t rx_chan;   /**< Channel incoming data is routed to */
+    uint8_t rx_esc;    /**< Last received byte was MUX_ESC */
+};
+
+/**
+ * @brief Global instance of the multiplexer, defined in uart.c
+ */
+extern struct Mux mux;
+
+/**
+ * @brief Initializes all logical channels
+ *
+ * @warning Do not call this function yourself. The init_UART() function takes
+ * care of this.
+ */
+void mux_init(void);
+
+/**
+ * @brief Get the RX or TX queue of a logical channel
+ *
+ * @param ch The channel number
+ * @param dir RX or TX
+ * @param mbuff ** to a MuxBuff struct, set to NULL if ch is out of range
+ */
+void get_mux_buffer(uint8_t ch, enum DIR_BUFFS dir, struct MuxBuff **mbuff);
+
+/**
+ * @brief Get one byte from the queue of a logical channel
+ *
+ * @param c Pointer to char variable
+ * @param ch The channel number
+ * @param dir Get the byte from the TX or RX queue
+ *
+ * @return 0 If the byte has been retrieved, 1 if the queue is empty, 2 if the
+ * channel does not exist
+ */
+uint8_t mux_pop(char *c, uint8_t ch, enum DIR_BUFFS dir);
+
+/**
+ * @brief Put one byte in the queue of a logical channel
+ *
+ * @param c A char variable
+ * @param ch The channel number
+ * @param dir Put the byte on the TX or RX queue
+ *
+ * @return 0 If the byte has been written, 1 if the queue is full, 2 if the
+ * channel does not exist
+ */
+uint8_t mux_push(char c, uint8_t ch, enum DIR_BUFFS dir);
+
+/**
+ * @brief Set the scheduling weight of a logical channel
+ *
+ * @param ch The channel number
+ * @param weight Number of bytes the channel may send before the next channel
+ * with pending data gets its turn. 0 is treated as 1.
+ */
+void mux_set_weight(uint8_t ch, uint8_t weight);
+
+/**
+ * @brief Send a single character on a logical channel
+ *
+ * @param ch The channel number
+ * @param c The character to send
+ *
+ * @return 0 If the character was queued, 1 otherwise
+ */
+uint8_t put_mux_UART(uint8_t ch, const char c);
+
+/**
+ * @brief Write a string followed by CR to a logical channel
+ *
+ * @param ch The channel number
+ * @param s The string you want to send
+ */
+void puts_mux_UART(uint8_t ch, const char *s);
+
+/**
+ * @brief Write binary data to a logical channel
+ *
+ * @param ch The channel number
+ * @param data Pointer to the data
+ * @param len Number of bytes to write
+ *
+ * @return Number of bytes that were queued. This is less than len if the
+ * channel queue ran full.
+ */
+size_t write_mux_UART(uint8_t ch, const char *data, size_t len);
+
+/**
+ * @brief Retrieve one char from the RX queue of a logical channel
+ *
+ * @param ch The channel number
+ * @param s Pointer to a char variable
+ *
+ * @return 0 If character was retrieved, 1 otherwise
+ */
+uint8_t get_mux_UART(uint8_t ch, char *s);
+
+/**
+ * @brief Get all data from the RX queue of a logical channel
+ *
+ * @param ch The channel number
+ * @param s Pointer to an array with room for MuxBuff#items plus `\0`
+ *
+ * @return 0 on success or 1 if the queue was empty
+ */
+uint8_t gets_mux_UART(uint8_t ch, char *s);
+
+#endif /* MUX_CHANNELS */
+
 #ifdef PRINTF
 
 /**
@@ -0,0 +1,167 @@
+/*
+ * uartavr interrupt driven serial communication for 8bit avrs
+ * Copyright © 2016 Christian Rapp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the organization nor the
+ * names of its contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ''AS IS'' AND ANY  EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL yourname BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*H**********************************************************************
+* FILENAME :        lzss_bench.c
+*
+* DESCRIPTION :
+*       Measure the throughput gain of TX_COMPRESS on sample logs
+*
+* NOTES :
+*       Every file is compressed like uartavr does it: every newline is
+*       followed by a carriage return (CR and CR_PRINTF in uart.h) and the
+*       encoder is flushed after it, the same way puts_UART() and printf do
+*       it. The result is decompressed again and compared with that stream.
+*
+*       With 8N1 framing a byte needs 10 bit times, so the raw link carries
+*       baud / 10 bytes per second. The effective rate is the raw rate times
+*       the compression ratio. It is the limit of the link only, the time the
+*       AVR needs to encode is not taken into account.
+*
+*       ./lzss_bench [-b baud] [-n] file...
+*       -n  do not flush after every line (one continuous stream)
+*
+* AUTHOR :    Christian Rapp
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lzss.h"
+
+static struct LZSSEncoder enc;
+static struct LZSSDecoder dec;
+
+static char *comp;
+static size_t comp_len;
+static char *plain;
+static size_t plain_len;
+
+static void comp_out(char c) { comp[comp_len++] = c; }
+static void plain_out(char c) { plain[plain_len++] = c; }
+
+static char *read_file(const char *name, size_t *len)
+{
+    FILE *f = fopen(name, "rb");
+    if (!f) {
+        perror(name);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *raw = malloc(size ? size : 1);
+    size_t raw_len = fread(raw, 1, size, f);
+    fclose(f);
+
+    /* the device sends "\n\r" for every newline */
+    char *data = malloc(raw_len * 2 + 1);
+    *len = 0;
+    for (size_t i = 0; i < raw_len; i++) {
+        data[(*len)++] = raw[i];
+        if (raw[i] == '\n')
+            data[(*len)++] = '\r';
+    }
+    free(raw);
+    return data;
+}
+
+int main(int argc, char **argv)
+{
+    long baud = 9600;
+    int flush_lines = 1;
+    int first = 1;
+    int ret = 0;
+
+    while (first < argc && argv[first][0] == '-') {
+        if (strcmp(argv[first], "-b") == 0 && first + 1 < argc) {
+            baud = atol(argv[++first]);
+        } else if (strcmp(argv[first], "-n") == 0) {
+            flush_lines = 0;
+        } else {
+            fprintf(stderr, "usage: %s [-b baud] [-n] file...\n", argv[0]);
+            return 2;
+        }
+        first++;
+    }
+    if (first == argc) {
+        fprintf(stderr, "usage: %s [-b baud] [-n] file...\n", argv[0]);
+        return 2;
+    }
+
+    double raw_rate = baud / 10.0;
+    printf("window %u bytes, max match %u, %ld baud (%.0f bytes/s raw)\n",
+           LZSS_WINDOW, LZSS_MAX_MATCH, baud, raw_rate);
+    printf("%-28s %9s %9s %7s %12s\n", "file", "in", "out", "ratio",
+           "eff bytes/s");
+
+    for (int i = first; i < argc; i++) {
+        size_t len = 0;
+        char *data = read_file(argv[i], &len);
+        if (!data) {
+            ret = 1;
+            continue;
+        }
+        /* worst case is 9 bits per byte plus a sync marker per line */
+        comp = malloc(len * 2 + 16);
+        plain = malloc(len + 1);
+        comp_len = 0;
+        plain_len = 0;
+
+        lzss_enc_init(&enc, comp_out);
+        for (size_t j = 0; j < len; j++) {
+            lzss_enc_put(&enc, data[j]);
+            if (flush_lines && data[j] == '\r' && j && data[j - 1] == '\n')
+                lzss_enc_flush(&enc);
+        }
+        lzss_enc_flush(&enc);
+
+        lzss_dec_init(&dec, plain_out);
+        for (size_t j = 0; j < comp_len; j++)
+            lzss_dec_put(&dec, comp[j]);
+
+        if (plain_len != len || memcmp(plain, data, len) != 0) {
+            printf("%-28s roundtrip FAILED\n", argv[i]);
+            ret = 1;
+        } else {
+            double ratio = comp_len ? (double)len / comp_len : 0;
+            printf("%-28s %9zu %9zu %6.2fx %12.0f\n", argv[i], len,
+                   comp_len, ratio, raw_rate * ratio);
+        }
+
+        free(comp);
+        free(plain);
+        free(data);
+    }
+
+    return ret;
+}
@@ -0,0 +1,52 @@
+#!/bin/sh
+#
+# Build the echo_callback and printf examples with different uartavr feature
+# sets and print flash and RAM usage as a markdown table. Needs avr-gcc,
+# avr-size and make.
+#
+# ./size_report.sh [feature set...]
+#
+# A feature set is a list of -D options that is appended to the CDEFS of the
+# example Makefile. Without arguments a default selection is used. Builds that
+# fail (e.g. echo_callback needs the RX callback) are shown as "-".
+
+cd "$(dirname "$0")/../examples" || exit 1
+
+if [ $# -eq 0 ]; then
+    set -- "" \
+        "-DNO_TX_CALLBACK -DNO_EMPTY_CALLBACK" \
+        "-DNO_CALLBACKS" \
+        "-DBUFFSIZE=32" \
+        "-DLOW_POWER" \
+        "-DTX_COMPRESS" \
+        "-DMUX_CHANNELS=2" \
+        "-DMPCM" \
+        "-DBAUD_RUNTIME"
+fi
+
+echo "| Example | Features | Flash (bytes) | RAM (bytes) |"
+echo "|---------|----------|---------------|-------------|"
+
+for example in echo_callback printf; do
+    base=$(sed -n 's/^CDEFS = //p' "$example/Makefile")
+    for features in "$@"; do
+        # the examples do not use --gc-sections, only link what is used
+        case "$features" in
+        *-DTX_COMPRESS*) srcs="../../src/uart.c ../../src/lzss.c" ;;
+        *) srcs="../../src/uart.c" ;;
+        esac
+        make -s -C "$example" clean >/dev/null 2>&1
+        if make -s -C "$example" CDEFS="$base $features" ASRC="$srcs" elf \
+            >/dev/null 2>&1; then
+            # text data bss dec hex filename
+            sizes=$(avr-size -B "$example"/*.elf | tail -n 1)
+            flash=$(echo "$sizes" | awk '{print $1 + $2}')
+            ram=$(echo "$sizes" | awk '{print $2 + $3}')
+        else
+            flash="-"
+            ram="-"
+        fi
+        echo "| $example | ${features:-default} | $flash | $ram |"
+    done
+    make -s -C "$example" clean >/dev/null 2>&1
+done
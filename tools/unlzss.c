@@ -0,0 +1,90 @@
+/*
+ * uartavr interrupt driven serial communication for 8bit avrs
+ * Copyright © 2016 Christian Rapp
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the organization nor the
+ * names of its contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ''AS IS'' AND ANY  EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL yourname BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*H**********************************************************************
+* FILENAME :        unlzss.c
+*
+* DESCRIPTION :
+*       Host side decompressor for the uartavr TX_COMPRESS stream
+*
+* NOTES :
+*       Reads the compressed stream from stdin (or a serial device given as
+*       argument) and writes the plain data to stdout. Output is flushed after
+*       every input chunk so you can pipe a live serial port through it.
+*
+*       stty -F /dev/ttyUSB0 9600 raw && ./unlzss /dev/ttyUSB0
+*
+* AUTHOR :    Christian Rapp
+*/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "lzss.h"
+
+static struct LZSSDecoder dec;
+
+static void out(char c) { putchar(c); }
+
+int main(int argc, char **argv)
+{
+    int fd = STDIN_FILENO;
+    if (argc > 1) {
+        fd = open(argv[1], O_RDONLY);
+        if (fd < 0) {
+            perror(argv[1]);
+            return 1;
+        }
+    }
+
+    lzss_dec_init(&dec, out);
+
+    /*
+     * read() returns whatever has arrived so far, fread() would wait for a
+     * full chunk and hold back lines that were flushed on the device
+     */
+    char chunk[256];
+    ssize_t n;
+    while ((n = read(fd, chunk, sizeof(chunk))) > 0) {
+        for (ssize_t i = 0; i < n; i++)
+            lzss_dec_put(&dec, chunk[i]);
+        fflush(stdout);
+    }
+    if (n < 0)
+        perror("read");
+
+    if (fd != STDIN_FILENO)
+        close(fd);
+    return n < 0 ? 1 : 0;
+}